@@ -2,6 +2,8 @@
 
 #include "Utils.h"
 #include "Interpolator.h"
+#include "EasingCache.h"
+#include "Snapshot.h"
 
 namespace animation {
 
@@ -19,6 +21,7 @@ public: // easy-to-use
     bool complete() const { return complete(Utils::now()); }
     TTime elapsed() const { return elapsed(Utils::now()); }
     TTime remaining() const { return remaining(Utils::now()); }
+    TTime nextUpdateTime() const { return nextUpdateTime(Utils::now()); }
 
 public:
     virtual void start(TTime start_time) = 0;
@@ -32,6 +35,43 @@ public:
     virtual TTime elapsed(TTime now) const = 0;
     virtual TTime remaining(TTime now) const { return duration() - elapsed(now); }
 
+    // When animate() next changes the output: `now` while running, the
+    // start time while waiting, TTimeMax once complete or not started.
+    // Only valid right after animate(now) at the same `now`: past the end
+    // it reports TTimeMax whether or not the complete state was written.
+    // The default never lets the caller sleep before completion.
+    virtual TTime nextUpdateTime(TTime now) const
+    {
+        return complete(now) ? TTimeMax : now;
+    }
+
+public:
+    // Animations sharing start time, duration and easing evaluate the curve
+    // once per frame through the cache, which must outlive them.
+    virtual void setEasingCache(EasingCache *cache) {}
+
+public:
+    // Captures the timing state of the whole tree and the current values of
+    // its targets, for rewinding it later with restore(). The tree must
+    // have the same shape when restored.
+    void snapshot(Snapshot &snapshot) const
+    {
+        snapshot.clear();
+        save(snapshot);
+    }
+
+    void restore(const Snapshot &snapshot)
+    {
+        SnapshotReader reader(snapshot);
+        load(reader);
+        assert(reader.done());
+    }
+
+    // Animations that don't override these store nothing, so restore()
+    // leaves them as they are; every animation in this library does.
+    virtual void save(Snapshot &snapshot) const {}
+    virtual void load(SnapshotReader &reader) {}
+
 };
 
 
@@ -46,6 +86,8 @@ public:
         , _duration(duration)
         , _interpolator(interpolator)
         , _start_time(TTimeMax)
+        , _easing_cache(nullptr)
+        , _easing(EasingCache::kNone)
     {
         assert(_duration > 0);
         assert(_interpolator);
@@ -65,6 +107,7 @@ public:
 
     virtual ~PropertyAnimation() override
     {
+        _releaseEasing();
         delete _interpolator;
     }
 
@@ -73,31 +116,47 @@ public: // from Animation
     {
         _start_time = start_time;
         assert(_start_time < TTimeMax);
+        _acquireEasing();
     }
 
     virtual bool animate(TTime now) override
     {
-        assert(_start_time < TTimeMax);
-        if (!started(now))
-        {
-            _target = _start_state;
-            return true;
-        }
-        if (complete(now))
-        {
-            _target = _complete_state;
-            return false;
-        }
-        double ratio = static_cast<double>(elapsed(now)) / duration();
-        ratio = _interpolator->value(ratio);
-        _target = (1.0 - ratio) * _start_state + ratio * _complete_state;
-        return true;
+        _target = value(now);
+        return !complete(now);
     }
 
     virtual void stop() override
     {
         _start_time = TTimeMax;
         _target = _complete_state;
+        _releaseEasing();
+    }
+
+    virtual void setEasingCache(EasingCache *cache) override
+    {
+        _releaseEasing();
+        _easing_cache = cache;
+        if (_start_time < TTimeMax) _acquireEasing();
+    }
+
+    virtual void save(Snapshot &snapshot) const override
+    {
+        snapshot.write(_start_time);
+        snapshot.write(_target);
+    }
+
+    virtual void load(SnapshotReader &reader) override
+    {
+        TTime start_time = TTimeMax;
+        reader.read(start_time);
+        reader.read(_target);
+        if (start_time == _start_time) return;
+        _start_time = start_time;
+        if (_start_time < TTimeMax) {
+            _acquireEasing();
+        } else {
+            _releaseEasing();
+        }
     }
 
 public: // from Animation
@@ -125,27 +184,46 @@ public: // from Animation
         return now - _start_time;
     }
 
+    virtual TTime nextUpdateTime(TTime now) const override
+    {
+        if (_start_time == TTimeMax) return TTimeMax;
+        if (!started(now)) return _start_time;
+        if (complete(now)) return TTimeMax;
+        return now;
+    }
+
 public:
     const T value() const { return value(Utils::now()); }
 
     const T value(TTime now) const
     {
         assert(_start_time < TTimeMax);
-        T ret = _start_state;
-        if (!started(now))
-        {
-            ret = _start_state;
-            return true;
-        }
-        if (complete(now))
-        {
-            ret = _complete_state;
-            return false;
-        }
+        if (!started(now)) return _start_state;
+        if (complete(now)) return _complete_state;
+        double ratio = _ratio(now);
+        return (1.0 - ratio) * _start_state + ratio * _complete_state;
+    }
+
+private:
+    double _ratio(TTime now) const
+    {
+        if (_easing != EasingCache::kNone) return _easing_cache->value(_easing, now);
         double ratio = static_cast<double>(elapsed(now)) / duration();
-        ratio = _interpolator->value(ratio);
-        ret = (1.0 - ratio) * _start_state + ratio * _complete_state;
-        return ret;
+        return _interpolator->value(ratio);
+    }
+
+    void _acquireEasing()
+    {
+        if (!_easing_cache) return;
+        _releaseEasing();
+        _easing = _easing_cache->acquire(_start_time, _duration, _interpolator);
+    }
+
+    void _releaseEasing()
+    {
+        if (_easing == EasingCache::kNone) return;
+        _easing_cache->release(_easing);
+        _easing = EasingCache::kNone;
     }
 
 private:
@@ -155,6 +233,8 @@ private:
     const TTime _duration;
     Interpolator *_interpolator;
     TTime _start_time;
+    EasingCache *_easing_cache;
+    size_t _easing;
 
 };
 
@@ -1,15 +1,346 @@
+#pragma once
+
 #include "Animation.h"
-#include <list>
+#include <vector>
+#include <map>
 #include <algorithm>
 
 namespace animation {
 
 
+struct AnimationHandle
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+
+// Owns the children of a group in one contiguous array. Handles index a
+// slot table whose generation is bumped on removal, so add and remove are
+// O(1) and stale handles are detected. erase() leaves a hole to keep the
+// order, swapErase() moves the last child into the gap.
+class AnimationStorage
+{
+public:
+    static const size_t kNone = static_cast<size_t>(-1);
+
+public:
+    AnimationStorage(): _holes(0) {}
+
+    AnimationStorage(const AnimationStorage &) = delete;
+    AnimationStorage &operator=(const AnimationStorage &) = delete;
+
+    ~AnimationStorage()
+    {
+        clear();
+    }
+
+public:
+    size_t size() const { return _animations.size(); }
+    size_t count() const { return _animations.size() - _holes; }
+    size_t holes() const { return _holes; }
+    Animation *operator[](size_t index) const { return _animations[index]; }
+
+    AnimationHandle insert(Animation *animation)
+    {
+        assert(animation);
+        uint32_t slot = _slots.size();
+        if (!_free.empty()) {
+            slot = _free.back();
+            _free.pop_back();
+        } else {
+            _slots.push_back(Slot());
+            _slots[slot].generation = 0;
+        }
+        _slots[slot].index = _animations.size();
+        _animations.push_back(animation);
+        _owners.push_back(slot);
+        AnimationHandle handle;
+        handle.index = slot;
+        handle.generation = _slots[slot].generation;
+        return handle;
+    }
+
+    size_t indexOf(AnimationHandle handle) const
+    {
+        if (handle.index >= _slots.size()) return kNone;
+        const Slot &slot = _slots[handle.index];
+        if (slot.generation != handle.generation) return kNone;
+        return slot.index;
+    }
+
+    size_t indexOf(const Animation *animation) const
+    {
+        auto found = std::find(_animations.begin(), _animations.end(), animation);
+        if (!animation || found == _animations.end()) return kNone;
+        return found - _animations.begin();
+    }
+
+    Animation *get(AnimationHandle handle) const
+    {
+        size_t index = indexOf(handle);
+        return index == kNone ? nullptr : _animations[index];
+    }
+
+    void erase(size_t index)
+    {
+        assert(_animations[index]);
+        _release(index);
+        _animations[index] = nullptr;
+        _holes++;
+    }
+
+    void swapErase(size_t index)
+    {
+        assert(_animations[index]);
+        _release(index);
+        const size_t last = _animations.size() - 1;
+        if (index != last) {
+            _animations[index] = _animations[last];
+            _owners[index] = _owners[last];
+            if (_animations[index]) _slots[_owners[index]].index = index;
+        }
+        _animations.pop_back();
+        _owners.pop_back();
+    }
+
+    void compact()
+    {
+        size_t kept = 0;
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            if (!_animations[index]) continue;
+            _animations[kept] = _animations[index];
+            _owners[kept] = _owners[index];
+            _slots[_owners[kept]].index = kept;
+            kept++;
+        }
+        _animations.resize(kept);
+        _owners.resize(kept);
+        _holes = 0;
+    }
+
+    void clear()
+    {
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            if (_animations[index]) _release(index);
+        }
+        _animations.clear();
+        _owners.clear();
+        _holes = 0;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t index;
+        uint32_t generation;
+    };
+
+    void _release(size_t index)
+    {
+        delete _animations[index];
+        const uint32_t slot = _owners[index];
+        _slots[slot].generation++;
+        _free.push_back(slot);
+    }
+
+private:
+    std::vector<Animation*> _animations;
+    std::vector<uint32_t> _owners;
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _free;
+    size_t _holes;
+
+};
+
+
+// Maps the clock a group is animated with onto the group's own timeline,
+// which runs from 0 to the group's end. Every change re-anchors the mapping
+// at the time it is made, clamped to that range, so the timeline stays
+// continuous, children are never restarted and time spent past either end
+// is not played back after a change of direction. Changes made before the
+// start apply from the start, which keeps the start delay.
+class TimeTransform
+{
+public:
+    TimeTransform()
+        : _start(TTimeMax)
+        , _anchor(TTimeMax)
+        , _local_anchor(0)
+        , _duration(0)
+        , _speed(1.0)
+        , _paused(false)
+        , _reversed(false)
+    {}
+
+public:
+    // Speed, pause and direction are kept: a reversed timeline starts from
+    // its end, a paused one holds its first frame until resumed.
+    void reset(TTime now, TTime duration)
+    {
+        _start = now;
+        _duration = duration;
+        _anchorAt(now, 0);
+    }
+
+    // The end moves when a slowed or paused child runs over its slot.
+    void setDuration(TTime duration) { _duration = duration; }
+
+    TTime local(TTime now) const
+    {
+        if (_paused) return _local_anchor;
+        const TTime delta = now - _anchor;
+        if (_speed == 1.0) return _local_anchor + (_reversed ? -delta : delta);
+        return _local_anchor + static_cast<TTime>(std::floor(delta * rate()));
+    }
+
+    // Inverse of local(), only meaningful while playing forward.
+    TTime global(TTime local) const
+    {
+        assert(!_paused && !_reversed);
+        if (_speed == 1.0) return _anchor + (local - _local_anchor);
+        return _anchor + static_cast<TTime>(std::ceil((local - _local_anchor) / _speed));
+    }
+
+    double rate() const
+    {
+        if (_paused) return 0.0;
+        return _reversed ? -_speed : _speed;
+    }
+
+    double speed() const { return _speed; }
+    bool paused() const { return _paused; }
+    bool reversed() const { return _reversed; }
+
+    void setSpeed(double speed, TTime now)
+    {
+        assert(speed > 0);
+        const TTime time = _time(now);
+        _speed = speed;
+        _anchorAt(now, time);
+    }
+
+    void setPaused(bool paused, TTime now)
+    {
+        const TTime time = _time(now);
+        _paused = paused;
+        _anchorAt(now, time);
+    }
+
+    void setReversed(bool reversed, TTime now)
+    {
+        const TTime time = _time(now);
+        _reversed = reversed;
+        _anchorAt(now, time);
+    }
+
+private:
+    TTime _time(TTime now) const
+    {
+        return now > _start ? local(now) : 0;
+    }
+
+    void _anchorAt(TTime now, TTime time)
+    {
+        if (now <= _start) {
+            _anchor = _start;
+            _local_anchor = _reversed ? _duration : 0;
+            return;
+        }
+        _anchor = now;
+        _local_anchor = std::min(std::max(time, TTime(0)), _duration);
+    }
+
+private:
+    TTime _start;
+    TTime _anchor;
+    TTime _local_anchor;
+    TTime _duration;
+    double _speed;
+    bool _paused;
+    bool _reversed;
+
+};
+
+
 class AnimationGroup: public Animation
 {
 public:
-    virtual void add(Animation *animation) = 0;
+    AnimationGroup()
+        : _now(0)
+        , _culled(false)
+    {}
+
+public:
+    virtual AnimationHandle add(Animation *animation) = 0;
+    virtual void remove(AnimationHandle handle) = 0;
     virtual void remove(Animation *animation) = 0;
+    virtual Animation *get(AnimationHandle handle) const = 0;
+
+public: // easy-to-use
+    // These apply at the time the group was last started or animated with,
+    // which for a nested group is its parent's timeline, not Utils::now().
+    void setSpeed(double speed) { setSpeed(speed, _now); }
+    void pause() { pause(_now); }
+    void resume() { resume(_now); }
+    void setReversed(bool reversed) { setReversed(reversed, _now); }
+
+public:
+    // Only the mapping of `now` onto the group's timeline changes, whatever
+    // the number of children; they see the transformed time when animated.
+    // The settings survive start(), see TimeTransform::reset().
+    void setSpeed(double speed, TTime now) { _transform.setSpeed(speed, now); }
+    void pause(TTime now) { _transform.setPaused(true, now); }
+    void resume(TTime now) { _transform.setPaused(false, now); }
+    void setReversed(bool reversed, TTime now) { _transform.setReversed(reversed, now); }
+    const TimeTransform &transform() const { return _transform; }
+
+    // A culled group keeps its timing but skips its whole subtree until it
+    // reaches its end, which is still animated so targets finish exact.
+    void setCulled(bool culled) { _culled = culled; }
+    bool culled() const { return _culled; }
+
+protected:
+    // While culled and running, only the end needs an update.
+    TTime _culledUpdateTime(TTime now, TTime end) const
+    {
+        if (_transform.paused()) return TTimeMax;
+        if (_transform.reversed()) return now;
+        return std::max(now, _transform.global(end));
+    }
+
+    // Time left in the caller's clock, so that a parent waits for a slowed
+    // group. A paused group reports what is left once resumed.
+    TTime _remaining(TTime now, TTime end) const
+    {
+        const TTime time = std::min(std::max(_transform.local(now), TTime(0)), end);
+        const TTime left = _transform.reversed() ? time : end - time;
+        if (_transform.speed() == 1.0) return left;
+        return static_cast<TTime>(std::ceil(left / _transform.speed()));
+    }
+
+    // When a child complete at `to`, but not before `from`, actually ended,
+    // so that what follows it doesn't lose the time a frame skipped past.
+    static TTime _completion(const Animation *animation, TTime from, TTime to)
+    {
+        while (from < to)
+        {
+            const TTime middle = from + (to - from) / 2;
+            if (animation->complete(middle)) {
+                to = middle;
+            } else {
+                from = middle + 1;
+            }
+        }
+        return to;
+    }
+
+protected:
+    TimeTransform _transform;
+    TTime _now;
+    bool _culled;
 
 };
 
@@ -20,17 +351,16 @@ public:
     SequentialAnimationGroup()
         : _duration(0)
         , _start_time(TTimeMax)
+        , _last_time(std::numeric_limits<TTime>::min())
+        , _current(0)
+        , _current_start(0)
+        , _current_end(0)
+        , _rest(0)
+        , _running(false)
+        , _laid_out(false)
+        , _easing_cache(nullptr)
     {}
 
-    virtual ~SequentialAnimationGroup() override
-    {
-        for (Animation *animation: _animations)
-        {
-            delete animation;
-        }
-        _animations.clear();
-    }
-
 public: // from Animation
     using Animation::start;
     using Animation::animate;
@@ -38,41 +368,131 @@ public: // from Animation
     using Animation::complete;
     using Animation::elapsed;
     using Animation::remaining;
+    using Animation::nextUpdateTime;
 
 public: // from Animation
+    // Children are laid out on the group's own timeline once, so starting
+    // again only moves the group's origin. Restoring a snapshot taken
+    // before the first start() brings back the need for a layout.
     virtual void start(TTime start_time) override
     {
         _start_time = start_time;
         assert(_start_time < TTimeMax);
-        TTime offset = _start_time;
-        for (Animation *animation: _animations)
-        {
-            animation->start(offset);
-            offset += animation->duration();
+        _now = start_time;
+        if (!_laid_out) {
+            _animations.compact();
+            _current = 0;
+            _last_time = std::numeric_limits<TTime>::min();
+            TTime offset = 0;
+            for (size_t index = 0; index < _animations.size(); index++)
+            {
+                _animations[index]->start(offset);
+                offset += _animations[index]->duration();
+            }
+            _current_start = 0;
+            _current_end = _animations.size() > 0 ? _animations[0]->duration() : 0;
+            _rest = _duration - _current_end;
+            _laid_out = true;
         }
+        _transform.reset(start_time, _end());
     }
 
+    // Each child starts where the previous one actually ended, so a slowed
+    // or paused child group delays the rest. Finished children are kept
+    // until stop() or destruction, so that time going backwards (reverse,
+    // restart, restore) can bring them back.
     virtual bool animate(TTime now) override
     {
         assert(_start_time < TTimeMax);
-        while (!_animations.empty()) {
-            Animation *animation = _animations.front();
-            if (animation->animate(now)) break;
-            delete _animations.front();
-            _animations.pop_front();
+        _now = now;
+        if (_culled && !complete(now)) {
+            _running = true;
+            return _running;
+        }
+        const TTime time = _transform.local(now);
+        if (time == _last_time && _transform.paused()) return _running;
+        if (time < _last_time && _animations.size() > 0) _rewind(time);
+        // the current child was still running at the previous time
+        TTime from = std::max(_current_start, _last_time);
+        _last_time = time;
+        while (_current < _animations.size())
+        {
+            Animation *animation = _animations[_current];
+            if (animation->animate(time)) {
+                if (time >= _current_end) _current_end = time + std::max(animation->remaining(time), TTime(1));
+                break;
+            }
+            _current_end = _completion(animation, std::min(from, time), time);
+            if (++_current == _animations.size()) break;
+            animation = _animations[_current];
+            animation->start(_current_end);
+            _current_start = _current_end;
+            from = _current_start;
+            _rest -= animation->duration();
+            _current_end += animation->duration();
         }
-        return !_animations.empty();
+        _transform.setDuration(_end());
+        _running = _transform.reversed() ? !complete(now) : _current < _animations.size();
+        return _running;
     }
 
     virtual void stop() override
     {
         _start_time = TTimeMax;
-        for (Animation *animation: _animations)
+        for (size_t index = _current; index < _animations.size(); index++)
         {
-            animation->stop();
-            delete animation;
+            if (_animations[index]) _animations[index]->stop();
         }
         _animations.clear();
+        _duration = 0;
+        _current = 0;
+        _current_start = 0;
+        _current_end = 0;
+        _rest = 0;
+        _laid_out = false;
+    }
+
+    virtual void setEasingCache(EasingCache *cache) override
+    {
+        _easing_cache = cache;
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            if (_animations[index]) _animations[index]->setEasingCache(cache);
+        }
+    }
+
+    virtual void save(Snapshot &snapshot) const override
+    {
+        snapshot.write(_start_time);
+        snapshot.write(_transform);
+        snapshot.write(_last_time);
+        snapshot.write(_current);
+        snapshot.write(_current_start);
+        snapshot.write(_current_end);
+        snapshot.write(_rest);
+        snapshot.write(_running);
+        snapshot.write(_laid_out);
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            if (_animations[index]) _animations[index]->save(snapshot);
+        }
+    }
+
+    virtual void load(SnapshotReader &reader) override
+    {
+        reader.read(_start_time);
+        reader.read(_transform);
+        reader.read(_last_time);
+        reader.read(_current);
+        reader.read(_current_start);
+        reader.read(_current_end);
+        reader.read(_rest);
+        reader.read(_running);
+        reader.read(_laid_out);
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            if (_animations[index]) _animations[index]->load(reader);
+        }
     }
 
 public: // from Animation
@@ -89,43 +509,112 @@ public: // from Animation
     virtual bool complete(TTime now) const override
     {
         assert(_start_time < TTimeMax);
-        return now >= _start_time + duration();
+        if (_transform.reversed()) return _transform.local(now) <= 0;
+        return _transform.local(now) >= _end();
     }
 
     virtual TTime elapsed(TTime now) const override
     {
         assert(_start_time < TTimeMax);
-        if (!started(now)) return 0;
-        if (complete(now)) return duration();
-        return now - _start_time;
+        return std::min(std::max(_transform.local(now), TTime(0)), _end());
+    }
+
+    virtual TTime remaining(TTime now) const override
+    {
+        assert(_start_time < TTimeMax);
+        return _remaining(now, _end());
+    }
+
+    virtual TTime nextUpdateTime(TTime now) const override
+    {
+        if (_start_time == TTimeMax) return TTimeMax;
+        if (_culled && !complete(now)) return _culledUpdateTime(now, _end());
+        const TTime time = _transform.local(now);
+        if (_transform.paused()) return time == _last_time ? TTimeMax : now;
+        if (_transform.reversed()) return time > 0 || time != _last_time ? now : TTimeMax;
+        if (time < _last_time) return now;
+        if (_current == _animations.size()) return TTimeMax;
+        // later children wait for this one, paused or not
+        const TTime next = _animations[_current]->nextUpdateTime(time);
+        if (next == TTimeMax) return TTimeMax;
+        return next <= time ? now : _transform.global(next);
     }
 
 public: // from AnimationGroup
-    virtual void add(Animation *animation) override
+    virtual AnimationHandle add(Animation *animation) override
     {
         assert(_start_time == TTimeMax);
         assert(animation);
-        auto found = std::find(_animations.begin(), _animations.end(), animation);
-        assert(found == _animations.end());
-        _animations.push_back(animation);
+        if (_easing_cache) animation->setEasingCache(_easing_cache);
         _duration += animation->duration();
+        _laid_out = false;
+        return _animations.insert(animation);
+    }
+
+    virtual void remove(AnimationHandle handle) override
+    {
+        _remove(_animations.indexOf(handle));
     }
 
     virtual void remove(Animation *animation) override
     {
-        assert(_start_time == TTimeMax);
-        auto found = std::find(_animations.begin(), _animations.end(), animation);
-        if (found != _animations.end()) {
-            _duration -= animation->duration();
-            delete *found;
-            _animations.erase(found);
+        _remove(_animations.indexOf(animation));
+    }
+
+    virtual Animation *get(AnimationHandle handle) const override
+    {
+        return _animations.get(handle);
+    }
+
+private:
+    TTime _end() const
+    {
+        return _current_end + _rest;
+    }
+
+    // Walks the cursor back to the child playing at `time`, animating the
+    // ones it leaves so they show their start state again.
+    void _rewind(TTime time)
+    {
+        if (_current == _animations.size()) _current--;
+        while (_current > 0 && !_animations[_current]->started(time))
+        {
+            _animations[_current]->animate(time);
+            _current--;
+            _rest += _animations[_current + 1]->duration();
+        }
+        Animation *animation = _animations[_current];
+        if (animation->started(time)) {
+            _current_start = time - animation->elapsed(time);
+            _current_end = time + animation->remaining(time);
+        } else {
+            _current_start = 0;
+            _current_end = animation->duration();
         }
     }
 
+    void _remove(size_t index)
+    {
+        assert(_start_time == TTimeMax);
+        if (index == AnimationStorage::kNone) return;
+        _duration -= _animations[index]->duration();
+        _animations.erase(index);
+        if (_animations.holes() * 2 > _animations.size()) _animations.compact();
+        _laid_out = false;
+    }
+
 private:
-    std::list<Animation*> _animations;
+    AnimationStorage _animations;
     TTime _duration;
     TTime _start_time;
+    TTime _last_time;
+    size_t _current;
+    TTime _current_start;
+    TTime _current_end;
+    TTime _rest;
+    bool _running;
+    bool _laid_out;
+    EasingCache *_easing_cache;
 
 };
 
@@ -135,18 +624,14 @@ class ParallelAnimationGroup: public AnimationGroup
 public:
     ParallelAnimationGroup()
         : _duration(0)
+        , _end(0)
         , _start_time(TTimeMax)
+        , _last_time(std::numeric_limits<TTime>::min())
+        , _running(false)
+        , _laid_out(false)
+        , _easing_cache(nullptr)
     {}
 
-    virtual ~ParallelAnimationGroup() override
-    {
-        for (Animation *animation: _animations)
-        {
-            delete animation;
-        }
-        _animations.clear();
-    }
-
 public: // from Animation
     using Animation::start;
     using Animation::animate;
@@ -154,41 +639,119 @@ public: // from Animation
     using Animation::complete;
     using Animation::elapsed;
     using Animation::remaining;
+    using Animation::nextUpdateTime;
 
 public: // from Animation
     virtual void start(TTime start_time) override
     {
         _start_time = start_time;
         assert(_start_time < TTimeMax);
-        for (Animation *animation: _animations)
+        _now = start_time;
+        _end = _duration;
+        _transform.reset(start_time, _end);
+        if (_laid_out) return;
+        for (size_t index = 0; index < _animations.size(); index++)
         {
-            animation->start(start_time);
+            _animations[index]->start(0);
         }
+        _activateAll();
+        _last_time = std::numeric_limits<TTime>::min();
+        _laid_out = true;
     }
 
+    // The group runs until every child is done, so a slowed or paused child
+    // group extends it. Finished children leave the active list but are
+    // kept until stop() or destruction; when time goes backwards they all
+    // become active again.
     virtual bool animate(TTime now) override
     {
         assert(_start_time < TTimeMax);
-        for (auto it = _animations.begin(); it != _animations.end();) {
-            if (!(*it)->animate(now)) {
-                delete *it;
-                it = _animations.erase(it);
+        _now = now;
+        if (_culled && !complete(now)) {
+            _running = true;
+            return _running;
+        }
+        const TTime time = _transform.local(now);
+        if (time == _last_time && _transform.paused()) return _running;
+        // active children were still running at the previous time
+        TTime from = 0;
+        if (time < _last_time) {
+            _activateAll();
+        } else {
+            from = std::max(from, std::min(_last_time, time));
+        }
+        _last_time = time;
+        TTime last = std::numeric_limits<TTime>::min();
+        for (size_t index = 0; index < _active.size();) {
+            Animation *animation = _animations[_active[index]];
+            if (!animation->animate(time)) {
+                last = std::max(last, _completion(animation, from, time));
+                _active[index] = _active.back();
+                _active.pop_back();
             } else {
-                it++;
+                if (time >= _end) _end = time + std::max(animation->remaining(time), TTime(1));
+                index++;
             }
         }
-        return !_animations.empty();
+        if (_active.empty() && last > std::numeric_limits<TTime>::min()) _end = last;
+        _transform.setDuration(_end);
+        _running = _transform.reversed() ? !complete(now) : !_active.empty();
+        return _running;
     }
 
     virtual void stop() override
     {
         _start_time = TTimeMax;
-        for (Animation *animation: _animations)
+        for (uint32_t index: _active)
         {
-            animation->stop();
-            delete animation;
+            _animations[index]->stop();
         }
         _animations.clear();
+        _active.clear();
+        _durations.clear();
+        _duration = 0;
+        _end = 0;
+        _laid_out = false;
+    }
+
+    virtual void setEasingCache(EasingCache *cache) override
+    {
+        _easing_cache = cache;
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            _animations[index]->setEasingCache(cache);
+        }
+    }
+
+    virtual void save(Snapshot &snapshot) const override
+    {
+        snapshot.write(_start_time);
+        snapshot.write(_transform);
+        snapshot.write(_end);
+        snapshot.write(_last_time);
+        snapshot.write(_running);
+        snapshot.write(_laid_out);
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            _animations[index]->save(snapshot);
+        }
+    }
+
+    // Every child becomes active again; those already finished at the next
+    // animate() write their complete state and drop out once more.
+    virtual void load(SnapshotReader &reader) override
+    {
+        reader.read(_start_time);
+        reader.read(_transform);
+        reader.read(_end);
+        reader.read(_last_time);
+        reader.read(_running);
+        reader.read(_laid_out);
+        for (size_t index = 0; index < _animations.size(); index++)
+        {
+            _animations[index]->load(reader);
+        }
+        _activateAll();
     }
 
 public: // from Animation
@@ -205,47 +768,101 @@ public: // from Animation
     virtual bool complete(TTime now) const override
     {
         assert(_start_time < TTimeMax);
-        return now >= _start_time + duration();
+        if (_transform.reversed()) return _transform.local(now) <= 0;
+        return _transform.local(now) >= _end;
     }
 
     virtual TTime elapsed(TTime now) const override
     {
         assert(_start_time < TTimeMax);
-        if (!started(now)) return 0;
-        if (complete(now)) return duration();
-        return now - _start_time;
+        return std::min(std::max(_transform.local(now), TTime(0)), _end);
+    }
+
+    virtual TTime remaining(TTime now) const override
+    {
+        assert(_start_time < TTimeMax);
+        return _remaining(now, _end);
+    }
+
+    virtual TTime nextUpdateTime(TTime now) const override
+    {
+        if (_start_time == TTimeMax) return TTimeMax;
+        if (_culled && !complete(now)) return _culledUpdateTime(now, _end);
+        const TTime time = _transform.local(now);
+        if (_transform.paused()) return time == _last_time ? TTimeMax : now;
+        if (_transform.reversed()) return time > 0 || time != _last_time ? now : TTimeMax;
+        if (time < _last_time) return now;
+        TTime ret = TTimeMax;
+        for (uint32_t index: _active)
+        {
+            ret = std::min(ret, _animations[index]->nextUpdateTime(time));
+            if (ret <= time) return now;
+        }
+        return ret == TTimeMax ? ret : _transform.global(ret);
     }
 
 public: // from AnimationGroup
-    virtual void add(Animation *animation) override
+    virtual AnimationHandle add(Animation *animation) override
     {
         assert(_start_time == TTimeMax);
         assert(animation);
-        auto found = std::find(_animations.begin(), _animations.end(), animation);
-        assert(found == _animations.end());
-        _animations.push_back(animation);
+        if (_easing_cache) animation->setEasingCache(_easing_cache);
+        _durations[animation->duration()]++;
         _duration = std::max(_duration, animation->duration());
+        _laid_out = false;
+        return _animations.insert(animation);
+    }
+
+    virtual void remove(AnimationHandle handle) override
+    {
+        _remove(_animations.indexOf(handle));
     }
 
     virtual void remove(Animation *animation) override
+    {
+        _remove(_animations.indexOf(animation));
+    }
+
+    virtual Animation *get(AnimationHandle handle) const override
+    {
+        return _animations.get(handle);
+    }
+
+private:
+    void _remove(size_t index)
     {
         assert(_start_time == TTimeMax);
-        auto found = std::find(_animations.begin(), _animations.end(), animation);
-        if (found != _animations.end()) {
-            delete *found;
-            _animations.erase(found);
-            _duration = 0;
-            for (Animation *animation: _animations)
-            {
-                _duration = std::max(_duration, animation->duration());
-            }
+        if (index == AnimationStorage::kNone) return;
+        // durations are counted per value, so the longest remaining one is
+        // known without rescanning the children
+        auto found = _durations.find(_animations[index]->duration());
+        assert(found != _durations.end());
+        if (--found->second == 0) _durations.erase(found);
+        _duration = _durations.empty() ? 0 : _durations.rbegin()->first;
+        _animations.swapErase(index);
+        _laid_out = false;
+    }
+
+    void _activateAll()
+    {
+        _active.resize(_animations.size());
+        for (size_t index = 0; index < _active.size(); index++)
+        {
+            _active[index] = index;
         }
     }
 
 private:
-    std::list<Animation*> _animations;
+    AnimationStorage _animations;
+    std::vector<uint32_t> _active;
+    std::map<TTime, size_t> _durations;
     TTime _duration;
+    TTime _end;
     TTime _start_time;
+    TTime _last_time;
+    bool _running;
+    bool _laid_out;
+    EasingCache *_easing_cache;
 
 };
 
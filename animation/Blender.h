@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Animation.h"
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+namespace animation {
+
+
+enum BlendMode
+{
+    BlendOverride,
+    BlendAdditive
+};
+
+
+// Layers several animations onto the same targets. Animations write into
+// per-layer slots returned by bind() instead of the real target; resolve()
+// then folds every target's layers in order and writes the target once.
+// An override layer lerps towards its slot by its weight, an additive
+// layer adds its offset from the value the target had when bound.
+template<typename T>
+class Blender
+{
+public:
+    size_t addLayer(double weight=1.0, BlendMode mode=BlendOverride)
+    {
+        Layer layer;
+        layer.weight = weight;
+        layer.mode = mode;
+        _layers.push_back(layer);
+        return _layers.size() - 1;
+    }
+
+    // Kept at a stable address so a PropertyAnimation<double> can drive it.
+    double &weight(size_t layer)
+    {
+        assert(layer < _layers.size());
+        return _layers[layer].weight;
+    }
+
+    T &bind(size_t layer, T &target)
+    {
+        assert(layer < _layers.size());
+        auto found = _indexes.find(&target);
+        if (found == _indexes.end()) {
+            Target entry;
+            entry.target = &target;
+            entry.base = target;
+            _targets.push_back(entry);
+            found = _indexes.emplace(&target, _targets.size() - 1).first;
+        }
+        Target &entry = _targets[found->second];
+        auto it = entry.contributions.begin();
+        while (it != entry.contributions.end() && it->layer < layer) it++;
+        if (it != entry.contributions.end() && it->layer == layer) return *it->slot;
+        _slots.push_back(entry.base);
+        Contribution contribution;
+        contribution.layer = layer;
+        contribution.slot = &_slots.back();
+        entry.contributions.insert(it, contribution);
+        return _slots.back();
+    }
+
+    void resolve()
+    {
+        for (Target &entry: _targets)
+        {
+            T value = entry.base;
+            for (const Contribution &contribution: entry.contributions)
+            {
+                const Layer &layer = _layers[contribution.layer];
+                if (layer.weight == 0.0) continue;
+                if (layer.mode == BlendOverride) {
+                    value = (1.0 - layer.weight) * value + layer.weight * *contribution.slot;
+                } else {
+                    value = value + layer.weight * (*contribution.slot - entry.base);
+                }
+            }
+            *entry.target = value;
+        }
+    }
+
+    // Animates a layer weight, e.g. fade(b, 1.0, 500) crossfades into an
+    // override layer b from whatever is below it.
+    Animation *fade(size_t layer, double weight, TTime duration, Interpolator *interpolator=new LinearInterpolator)
+    {
+        return new PropertyAnimation<double>(this->weight(layer), weight, duration, interpolator);
+    }
+
+public:
+    size_t layers() const { return _layers.size(); }
+    size_t targets() const { return _targets.size(); }
+
+private:
+    struct Layer
+    {
+        double weight;
+        BlendMode mode;
+    };
+
+    struct Contribution
+    {
+        size_t layer;
+        T *slot;
+    };
+
+    struct Target
+    {
+        T *target;
+        T base;
+        std::vector<Contribution> contributions;
+    };
+
+private:
+    std::deque<Layer> _layers;
+    std::deque<T> _slots;
+    std::vector<Target> _targets;
+    std::unordered_map<T*, size_t> _indexes;
+
+};
+
+
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "Animation.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <cstddef>
+
+namespace animation {
+
+
+// Uniformly sampled scalar curve stored as a constant, or as linear keys.
+// Keys are dropped while linear interpolation between the kept ones stays
+// within the tolerance, and values are quantized to 8 or 16 bits over the
+// track range; together the error stays under `tolerance`. When 16 bits
+// are too coarse the keys are stored unquantized, and when reduction keeps
+// too many keys to pay for their frame indexes every sample is stored.
+// Integral tracks round their values, which may add up to 0.5 to the
+// error; maxError() is measured after rounding.
+template<typename T>
+class CompressedTrack
+{
+public:
+    CompressedTrack(const std::vector<T> &samples, TTime interval, double tolerance)
+        : _interval(interval)
+        , _sample_count(samples.size())
+        , _encoding(Constant)
+        , _minimum(0)
+        , _scale(0)
+        , _raw_size(samples.size() * sizeof(T))
+        , _max_error(0)
+    {
+        assert(!samples.empty());
+        assert(samples.size() <= kMaxSamples);
+        assert(_interval > 0);
+        assert(tolerance >= 0);
+
+        auto range = std::minmax_element(samples.begin(), samples.end());
+        const double minimum = *range.first;
+        const double maximum = *range.second;
+        if (maximum - minimum <= 2 * tolerance) {
+            _minimum = (minimum + maximum) / 2;
+            _measure(samples);
+            return;
+        }
+
+        // spend at most half the tolerance on quantization
+        _minimum = minimum;
+        double reduction = tolerance;
+        if ((maximum - minimum) / 255 <= tolerance) {
+            _encoding = Quantized8;
+            _scale = (maximum - minimum) / 255;
+        } else if ((maximum - minimum) / 65535 <= tolerance) {
+            _encoding = Quantized16;
+            _scale = (maximum - minimum) / 65535;
+        } else {
+            _encoding = Raw;
+        }
+        if (_encoding != Raw) reduction -= _scale / 2;
+
+        _reduce(samples, reduction);
+        if (_frames.size() * (sizeof(uint16_t) + _keyBytes()) >= samples.size() * _keyBytes()) {
+            _frames.clear();
+            _values.clear();
+            for (const T &sample: samples)
+            {
+                _append(sample);
+            }
+        }
+
+        _measure(samples);
+    }
+
+public:
+    TTime duration() const { return (_sample_count - 1) * _interval; }
+    size_t keys() const { return _encoding == Constant ? 1 : _values.size() / _keyBytes(); }
+    bool constant() const { return _encoding == Constant; }
+
+    size_t size() const
+    {
+        return sizeof(*this) + _frames.size() * sizeof(uint16_t) + _values.size();
+    }
+
+    double compressionRatio() const { return static_cast<double>(_raw_size) / size(); }
+    double maxError() const { return _max_error; }
+
+    // `cursor` caches the key span of the previous call for one player, so
+    // sequential playback is O(1) amortized; random access falls back to a
+    // binary search. Any value is a valid hint.
+    T value(TTime time, size_t &cursor) const
+    {
+        if (time <= 0) return _convert(_value(0, cursor));
+        double position = static_cast<double>(time) / _interval;
+        return _convert(_value(position, cursor));
+    }
+
+    T value(TTime time) const
+    {
+        size_t cursor = 0;
+        return value(time, cursor);
+    }
+
+private:
+    enum Encoding
+    {
+        Constant,
+        Quantized8,
+        Quantized16,
+        Raw,
+    };
+
+    // Measured on what value() returns, so rounding is included.
+    void _measure(const std::vector<T> &samples)
+    {
+        size_t cursor = 0;
+        for (size_t index = 0; index < samples.size(); index++)
+        {
+            double error = std::abs(static_cast<double>(value(index * _interval, cursor)) - samples[index]);
+            _max_error = std::max(_max_error, error);
+        }
+    }
+
+    // Integral tracks round to the nearest value instead of truncating.
+    static T _convert(double value)
+    {
+        return static_cast<T>(std::is_integral<T>::value ? std::round(value) : value);
+    }
+
+    size_t _keyBytes() const
+    {
+        switch (_encoding)
+        {
+        case Quantized8:  return 1;
+        case Quantized16: return 2;
+        case Raw:         return sizeof(T);
+        default:          return 0;
+        }
+    }
+
+    // Greedy line fitting. The slopes from the anchor that keep every
+    // sample passed so far within the tolerance form a cone that only
+    // narrows, so each candidate end is checked in O(1).
+    void _reduce(const std::vector<T> &samples, double tolerance)
+    {
+        const size_t last = samples.size() - 1;
+        size_t anchor = 0;
+        _frames.push_back(0);
+        _append(samples[0]);
+        while (anchor < last)
+        {
+            const double from = samples[anchor];
+            double lower = -std::numeric_limits<double>::infinity();
+            double upper = std::numeric_limits<double>::infinity();
+            size_t next = anchor + 1;
+            while (next < last)
+            {
+                const double offset = next - anchor;
+                lower = std::max(lower, (samples[next] - tolerance - from) / offset);
+                upper = std::min(upper, (samples[next] + tolerance - from) / offset);
+                const double slope = (samples[next + 1] - from) / (offset + 1);
+                if (slope < lower || slope > upper) break;
+                next++;
+            }
+            _frames.push_back(static_cast<uint16_t>(next));
+            _append(samples[next]);
+            anchor = next;
+        }
+    }
+
+    void _append(const T &value)
+    {
+        if (_encoding == Raw) {
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+            _values.insert(_values.end(), bytes, bytes + sizeof(T));
+            return;
+        }
+        const uint32_t quantized = static_cast<uint32_t>((value - _minimum) / _scale + 0.5);
+        _values.push_back(static_cast<uint8_t>(quantized & 0xff));
+        if (_encoding == Quantized16) _values.push_back(static_cast<uint8_t>(quantized >> 8));
+    }
+
+    double _key(size_t index) const
+    {
+        switch (_encoding)
+        {
+        case Quantized8:
+            return _minimum + _values[index] * _scale;
+        case Quantized16:
+            return _minimum + (_values[index * 2] | (_values[index * 2 + 1] << 8)) * _scale;
+        default:
+            T value;
+            memcpy(&value, &_values[index * sizeof(T)], sizeof(T));
+            return value;
+        }
+    }
+
+    // Every sample is a key when no frame indexes are stored.
+    double _frame(size_t index) const
+    {
+        return _frames.empty() ? index : _frames[index];
+    }
+
+    double _value(double position, size_t &cursor) const
+    {
+        if (_encoding == Constant) return _minimum;
+        const size_t count = keys();
+        if (position >= _frame(count - 1)) return _key(count - 1);
+        if (cursor + 1 >= count || _frame(cursor) > position || _frame(cursor + 1) <= position) {
+            if (_frames.empty()) {
+                cursor = static_cast<size_t>(position);
+            } else {
+                auto found = std::upper_bound(_frames.begin(), _frames.end(), position);
+                cursor = found - _frames.begin() - 1;
+            }
+        }
+        const double from = _frame(cursor);
+        const double to = _frame(cursor + 1);
+        double ratio = (position - from) / (to - from);
+        return (1.0 - ratio) * _key(cursor) + ratio * _key(cursor + 1);
+    }
+
+private:
+    static const size_t kMaxSamples = 65536;
+
+    const TTime _interval;
+    const size_t _sample_count;
+    Encoding _encoding;
+    double _minimum;
+    double _scale;
+    const size_t _raw_size;
+    double _max_error;
+    std::vector<uint16_t> _frames;
+    std::vector<uint8_t> _values;
+
+};
+
+
+// Plays a CompressedTrack into a target, like PropertyAnimation. The track
+// is borrowed so that one library curve can drive many targets; each player
+// keeps its own key cursor.
+template<typename T>
+class TrackAnimation: public Animation
+{
+public:
+    TrackAnimation(T &target, const CompressedTrack<T> *track)
+        : _target(target)
+        , _track(track)
+        , _start_time(TTimeMax)
+        , _cursor(0)
+    {
+        assert(_track);
+        assert(_track->duration() > 0);
+    }
+
+public: // from Animation
+    virtual void start(TTime start_time) override
+    {
+        _start_time = start_time;
+        assert(_start_time < TTimeMax);
+    }
+
+    virtual bool animate(TTime now) override
+    {
+        assert(_start_time < TTimeMax);
+        _target = _track->value(elapsed(now), _cursor);
+        return !complete(now);
+    }
+
+    virtual void stop() override
+    {
+        _start_time = TTimeMax;
+        _target = _track->value(duration(), _cursor);
+    }
+
+    virtual void save(Snapshot &snapshot) const override
+    {
+        snapshot.write(_start_time);
+        snapshot.write(_target);
+    }
+
+    virtual void load(SnapshotReader &reader) override
+    {
+        reader.read(_start_time);
+        reader.read(_target);
+    }
+
+public: // from Animation
+    virtual TTime duration() const override
+    {
+        return _track->duration();
+    }
+
+    virtual bool started(TTime now) const override
+    {
+        return now >= _start_time;
+    }
+
+    virtual bool complete(TTime now) const override
+    {
+        assert(_start_time < TTimeMax);
+        return now >= _start_time + duration();
+    }
+
+    virtual TTime elapsed(TTime now) const override
+    {
+        assert(_start_time < TTimeMax);
+        if (!started(now)) return 0;
+        if (complete(now)) return duration();
+        return now - _start_time;
+    }
+
+    virtual TTime nextUpdateTime(TTime now) const override
+    {
+        if (_start_time == TTimeMax) return TTimeMax;
+        if (!started(now)) return _start_time;
+        if (complete(now)) return TTimeMax;
+        return now;
+    }
+
+private:
+    T &_target;
+    const CompressedTrack<T> *_track;
+    TTime _start_time;
+    size_t _cursor;
+
+};
+
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Interpolator.h"
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstddef>
+
+namespace animation {
+
+
+// Shares eased ratios between animations with the same start time,
+// duration and an equal interpolator: each unique key evaluates its curve
+// at most once per timestamp, every other user only reads the result.
+class EasingCache
+{
+public:
+    static const size_t kNone = static_cast<size_t>(-1);
+
+public:
+    EasingCache(): _evaluations(0) {}
+
+    EasingCache(const EasingCache &) = delete;
+    EasingCache &operator=(const EasingCache &) = delete;
+
+    ~EasingCache()
+    {
+        for (Entry &entry: _entries)
+        {
+            delete entry.interpolator;
+        }
+        _entries.clear();
+    }
+
+public:
+    // Returns kNone if the interpolator can't be shared.
+    size_t acquire(TTime start_time, TTime duration, const Interpolator *interpolator)
+    {
+        assert(interpolator);
+        const Key key(start_time, duration);
+        auto range = _keys.equal_range(key);
+        for (auto it = range.first; it != range.second; it++)
+        {
+            Entry &entry = _entries[it->second];
+            if (entry.interpolator->equals(*interpolator)) {
+                entry.references++;
+                return it->second;
+            }
+        }
+        Interpolator *shared = interpolator->clone();
+        if (!shared) return kNone;
+
+        size_t id = _entries.size();
+        if (!_free.empty()) {
+            id = _free.back();
+            _free.pop_back();
+        } else {
+            _entries.push_back(Entry());
+        }
+        Entry &entry = _entries[id];
+        entry.start_time = start_time;
+        entry.duration = duration;
+        entry.interpolator = shared;
+        entry.now = TTimeMax;
+        entry.value = 0;
+        entry.references = 1;
+        _keys.insert(std::make_pair(key, id));
+        return id;
+    }
+
+    void release(size_t id)
+    {
+        if (id == kNone) return;
+        assert(id < _entries.size());
+        Entry &entry = _entries[id];
+        assert(entry.references > 0);
+        if (--entry.references > 0) return;
+        auto range = _keys.equal_range(Key(entry.start_time, entry.duration));
+        for (auto it = range.first; it != range.second; it++)
+        {
+            if (it->second == id) {
+                _keys.erase(it);
+                break;
+            }
+        }
+        delete entry.interpolator;
+        entry.interpolator = nullptr;
+        _free.push_back(id);
+    }
+
+    double value(size_t id, TTime now)
+    {
+        assert(id < _entries.size());
+        Entry &entry = _entries[id];
+        if (entry.now != now) {
+            double ratio = static_cast<double>(now - entry.start_time) / entry.duration;
+            entry.value = entry.interpolator->value(ratio);
+            entry.now = now;
+            _evaluations++;
+        }
+        return entry.value;
+    }
+
+public:
+    size_t size() const { return _keys.size(); }
+    size_t evaluations() const { return _evaluations; }
+
+private:
+    typedef std::pair<TTime, TTime> Key;
+
+    struct Entry
+    {
+        TTime start_time;
+        TTime duration;
+        Interpolator *interpolator;
+        TTime now;
+        double value;
+        size_t references;
+    };
+
+private:
+    std::vector<Entry> _entries;
+    std::vector<size_t> _free;
+    std::multimap<Key, size_t> _keys;
+    size_t _evaluations;
+
+};
+
+
+}
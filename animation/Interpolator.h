@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utils.h"
+#include <typeinfo>
 
 namespace animation {
 
@@ -17,6 +18,13 @@ public:
         return _value(normalized);
     }
 
+    // Interpolators that can be cloned and compared may be evaluated once
+    // for many animations sharing the same timing, see EasingCache. clone()
+    // returns nullptr for classes that don't override it; the built-in
+    // ones also return nullptr when subclassed, as a copy would slice.
+    virtual Interpolator *clone() const { return nullptr; }
+    virtual bool equals(const Interpolator &other) const { return this == &other; }
+
 private:
     double _normalize(double ratio) const
     {
@@ -32,6 +40,18 @@ private:
 
 class LinearInterpolator: public Interpolator
 {
+public:
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(LinearInterpolator)) return nullptr;
+        return new LinearInterpolator;
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        return typeid(other) == typeid(*this);
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
@@ -46,6 +66,18 @@ class PowerInterpolator: public Interpolator
 public:
     PowerInterpolator(double power=2): _power(power) {}
 
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(PowerInterpolator)) return nullptr;
+        return new PowerInterpolator(_power);
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        if (typeid(other) != typeid(*this)) return false;
+        return static_cast<const PowerInterpolator&>(other)._power == _power;
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
@@ -63,6 +95,19 @@ public:
     BackInterpolator(double overflow=1.70158, double power=2)
         : _overflow(overflow), _power(power) {}
 
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(BackInterpolator)) return nullptr;
+        return new BackInterpolator(_overflow, _power);
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        if (typeid(other) != typeid(*this)) return false;
+        const BackInterpolator &back = static_cast<const BackInterpolator&>(other);
+        return back._overflow == _overflow && back._power == _power;
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
@@ -79,6 +124,18 @@ private:
 
 class SineInterpolator: public Interpolator
 {
+public:
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(SineInterpolator)) return nullptr;
+        return new SineInterpolator;
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        return typeid(other) == typeid(*this);
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
@@ -93,6 +150,18 @@ class ExponentialInterpolator: public Interpolator
 public:
     ExponentialInterpolator(double lambda=0.1): _lambda(lambda) {}
 
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(ExponentialInterpolator)) return nullptr;
+        return new ExponentialInterpolator(_lambda);
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        if (typeid(other) != typeid(*this)) return false;
+        return static_cast<const ExponentialInterpolator&>(other)._lambda == _lambda;
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
@@ -118,6 +187,19 @@ public:
         delete _interpolator;
     }
 
+    virtual Interpolator *clone() const override
+    {
+        if (typeid(*this) != typeid(InverseInterpolator)) return nullptr;
+        Interpolator *interpolator = _interpolator->clone();
+        return interpolator ? new InverseInterpolator(interpolator) : nullptr;
+    }
+
+    virtual bool equals(const Interpolator &other) const override
+    {
+        if (typeid(other) != typeid(*this)) return false;
+        return static_cast<const InverseInterpolator&>(other)._interpolator->equals(*_interpolator);
+    }
+
 private:
     virtual double _value(double ratio) const override
     {
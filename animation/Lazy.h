@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Animation.h"
+
+namespace animation {
+
+
+// Pull-based counterpart of PropertyAnimation: animate() only records the
+// time it was given, get() computes the value for that time on first read
+// and memoizes it. As an Animation it can be sequenced, delayed and culled
+// like any other leaf of a group; while its group is culled it isn't
+// animated, so get() keeps returning the last value.
+template<typename T>
+class LazyProperty: public Animation
+{
+public:
+    LazyProperty(T start_state, T complete_state, TTime duration, Interpolator *interpolator=new LinearInterpolator)
+        : _value(start_state)
+        , _time(TTimeMax)
+        , _evaluated(TTimeMax)
+        , _animation(_value, start_state, complete_state, duration, interpolator)
+    {}
+
+    LazyProperty(const LazyProperty &) = delete;
+    LazyProperty &operator=(const LazyProperty &) = delete;
+
+public:
+    const T &get()
+    {
+        if (_time != _evaluated && _time != TTimeMax) {
+            _value = _animation.value(_time);
+            _evaluated = _time;
+        }
+        return _value;
+    }
+
+public: // from Animation
+    using Animation::start;
+    using Animation::animate;
+    using Animation::started;
+    using Animation::complete;
+    using Animation::elapsed;
+    using Animation::remaining;
+    using Animation::nextUpdateTime;
+
+public: // from Animation
+    virtual void start(TTime start_time) override
+    {
+        _animation.start(start_time);
+        _time = TTimeMax;
+        _evaluated = TTimeMax;
+    }
+
+    virtual bool animate(TTime now) override
+    {
+        _time = now;
+        return !_animation.complete(now);
+    }
+
+    virtual void stop() override
+    {
+        _animation.stop();
+        _time = TTimeMax;
+        _evaluated = TTimeMax;
+    }
+
+    virtual void setEasingCache(EasingCache *cache) override
+    {
+        _animation.setEasingCache(cache);
+    }
+
+    virtual void save(Snapshot &snapshot) const override
+    {
+        _animation.save(snapshot);
+        snapshot.write(_time);
+        snapshot.write(_evaluated);
+    }
+
+    virtual void load(SnapshotReader &reader) override
+    {
+        _animation.load(reader);
+        reader.read(_time);
+        reader.read(_evaluated);
+    }
+
+public: // from Animation
+    virtual TTime duration() const override { return _animation.duration(); }
+    virtual bool started(TTime now) const override { return _animation.started(now); }
+    virtual bool complete(TTime now) const override { return _animation.complete(now); }
+    virtual TTime elapsed(TTime now) const override { return _animation.elapsed(now); }
+    virtual TTime nextUpdateTime(TTime now) const override { return _animation.nextUpdateTime(now); }
+
+private:
+    T _value;
+    TTime _time;
+    TTime _evaluated;
+    PropertyAnimation<T> _animation;
+
+};
+
+
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "Animation.h"
+#include <vector>
+#include <queue>
+#include <functional>
+#include <limits>
+#include <cstddef>
+
+namespace animation {
+
+
+// Updates a set of started animations under a per-frame time budget.
+// Each priority class is guaranteed a share of the budget, and what a class
+// leaves unused goes to the others in priority order; work that doesn't fit
+// is deferred and resumed from the same place on a later frame. Reduced
+// rate animations are only visited on their frames. The budget is in
+// microseconds, 0 disables it.
+//
+// Completion is tracked separately, ordered by deadline: an animation that
+// has reached its end is animated on that frame whatever its rate or the
+// budget, so its target receives the exact complete state. Deadlines come
+// from remaining(), which must not overestimate the time to completion.
+// Finishing animations and the first deadline of newly added ones are the
+// only work done outside the budget.
+class Scheduler
+{
+public:
+    enum Priority
+    {
+        High,
+        Normal,
+        Low,
+        PriorityCount
+    };
+
+    enum Rate
+    {
+        EveryFrame = 1,
+        HalfRate = 2,
+        QuarterRate = 4
+    };
+
+    struct Stats
+    {
+        size_t updated;
+        size_t skipped;
+        size_t deferred[PriorityCount];
+        size_t completed;
+        TTime spent;
+        size_t total_deferred;
+    };
+
+public:
+    Scheduler(TTime budget=0)
+        : _budget(budget)
+        , _frame(0)
+        , _added(0)
+        , _size(0)
+        , _stats()
+    {
+        for (size_t bucket = 0; bucket < kBucketCount; bucket++)
+        {
+            _cursors[bucket] = 0;
+            _pending[bucket] = 0;
+        }
+    }
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    ~Scheduler()
+    {
+        for (Entry &entry: _entries)
+        {
+            delete entry.animation;
+        }
+        _entries.clear();
+    }
+
+public: // easy-to-use
+    bool animate() { return animate(Utils::now()); }
+
+public:
+    void add(Animation *animation, Priority priority=Normal, Rate rate=EveryFrame)
+    {
+        assert(animation);
+        assert(priority >= High && priority < PriorityCount);
+        uint32_t slot = _entries.size();
+        if (!_free.empty()) {
+            slot = _free.back();
+            _free.pop_back();
+        } else {
+            _entries.push_back(Entry());
+            _entries.back().serial = 0;
+        }
+        Entry &entry = _entries[slot];
+        entry.animation = animation;
+        // spread animations of the same rate class over its frames
+        entry.bucket = priority * kBucketsPerPriority + rate - 1 + _added++ % rate;
+        entry.position = _buckets[entry.bucket].size();
+        _buckets[entry.bucket].push_back(slot);
+        // the first frame computes the real deadline
+        _deadlines.push(Deadline(std::numeric_limits<TTime>::min(), slot, entry.serial));
+        _size++;
+    }
+
+    void remove(Animation *animation)
+    {
+        for (uint32_t slot = 0; slot < _entries.size(); slot++)
+        {
+            if (_entries[slot].animation == animation) {
+                _retire(slot);
+                return;
+            }
+        }
+    }
+
+    bool animate(TTime now)
+    {
+        _frame++;
+        _stats.updated = 0;
+        _stats.skipped = 0;
+        _stats.completed = 0;
+        const TTime begin = Utils::microseconds();
+
+        _complete(now);
+
+        size_t due[kBucketCount];
+        size_t count = 0;
+        for (size_t bucket = 0; bucket < kBucketCount; bucket++)
+        {
+            if (_due(bucket)) {
+                _pending[bucket] = _buckets[bucket].size();
+                due[count++] = bucket;
+            } else {
+                _pending[bucket] = 0;
+                _stats.skipped += _buckets[bucket].size();
+            }
+        }
+
+        if (_budget > 0) {
+            const TTime left = begin + _budget - Utils::microseconds();
+            for (int priority = 0; priority < PriorityCount && left > 0; priority++)
+            {
+                const TTime stop = Utils::microseconds() + left * _share(priority) / 100;
+                _update(now, due, count, priority, stop);
+            }
+            for (int priority = 0; priority < PriorityCount; priority++)
+            {
+                _update(now, due, count, priority, begin + _budget);
+            }
+        } else {
+            for (int priority = 0; priority < PriorityCount; priority++)
+            {
+                _update(now, due, count, priority, TTimeMax);
+            }
+        }
+
+        for (int priority = 0; priority < PriorityCount; priority++)
+        {
+            _stats.deferred[priority] = 0;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            _stats.deferred[due[i] / kBucketsPerPriority] += _pending[due[i]];
+            _stats.total_deferred += _pending[due[i]];
+        }
+        _stats.spent = Utils::microseconds() - begin;
+        return _size > 0;
+    }
+
+public:
+    TTime budget() const { return _budget; }
+    void setBudget(TTime budget) { _budget = budget; }
+
+    const Stats &stats() const { return _stats; }
+    size_t size() const { return _size; }
+
+private:
+    // one bucket per phase of each rate: 1 + 2 + 4
+    static const size_t kBucketsPerPriority = 7;
+    static const size_t kBucketCount = PriorityCount * kBucketsPerPriority;
+
+    struct Entry
+    {
+        Animation *animation;
+        uint32_t bucket;
+        uint32_t position;
+        uint32_t serial;
+    };
+
+    struct Deadline
+    {
+        Deadline(TTime time, uint32_t slot, uint32_t serial)
+            : time(time), slot(slot), serial(serial) {}
+
+        bool operator>(const Deadline &other) const { return time > other.time; }
+
+        TTime time;
+        uint32_t slot;
+        uint32_t serial;
+    };
+
+    // Percentage of the budget guaranteed to each priority class.
+    static TTime _share(int priority)
+    {
+        static const TTime shares[PriorityCount] = { 50, 30, 20 };
+        return shares[priority];
+    }
+
+    bool _due(size_t bucket) const
+    {
+        const size_t offset = bucket % kBucketsPerPriority;
+        if (offset == 0) return true;
+        if (offset < 3) return offset - 1 == _frame % 2;
+        return offset - 3 == _frame % 4;
+    }
+
+    // Animates everything whose deadline has passed; those not actually
+    // complete yet are pushed back with a fresh deadline.
+    void _complete(TTime now)
+    {
+        while (!_deadlines.empty() && _deadlines.top().time <= now)
+        {
+            const Deadline deadline = _deadlines.top();
+            _deadlines.pop();
+            Entry &entry = _entries[deadline.slot];
+            if (entry.serial != deadline.serial || !entry.animation) continue;
+            if (entry.animation->complete(now)) {
+                _stats.updated++;
+                if (!entry.animation->animate(now)) {
+                    _retire(deadline.slot);
+                    _stats.completed++;
+                    continue;
+                }
+            }
+            const TTime remaining = entry.animation->remaining(now);
+            _deadlines.push(Deadline(now + (remaining > 0 ? remaining : 1), deadline.slot, deadline.serial));
+        }
+    }
+
+    void _update(TTime now, const size_t *due, size_t count, int priority, TTime stop)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t bucket = due[i];
+            if (bucket / kBucketsPerPriority != static_cast<size_t>(priority)) continue;
+            std::vector<uint32_t> &slots = _buckets[bucket];
+            while (_pending[bucket] > 0)
+            {
+                if (_budget > 0 && Utils::microseconds() >= stop) return;
+                _pending[bucket]--;
+                if (_cursors[bucket] >= slots.size()) _cursors[bucket] = 0;
+                const uint32_t slot = slots[_cursors[bucket]];
+                _stats.updated++;
+                if (_entries[slot].animation->animate(now)) {
+                    _cursors[bucket]++;
+                } else {
+                    // the last slot moves into the cursor position
+                    _retire(slot);
+                    _stats.completed++;
+                }
+            }
+        }
+    }
+
+    void _retire(uint32_t slot)
+    {
+        Entry &entry = _entries[slot];
+        std::vector<uint32_t> &slots = _buckets[entry.bucket];
+        const uint32_t moved = slots.back();
+        slots[entry.position] = moved;
+        _entries[moved].position = entry.position;
+        slots.pop_back();
+        delete entry.animation;
+        entry.animation = nullptr;
+        entry.serial++;
+        _free.push_back(slot);
+        _size--;
+    }
+
+private:
+    std::vector<Entry> _entries;
+    std::vector<uint32_t> _free;
+    std::vector<uint32_t> _buckets[kBucketCount];
+    size_t _cursors[kBucketCount];
+    size_t _pending[kBucketCount];
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> _deadlines;
+    TTime _budget;
+    uint64_t _frame;
+    uint64_t _added;
+    size_t _size;
+    Stats _stats;
+
+};
+
+
+}
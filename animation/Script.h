@@ -0,0 +1,469 @@
+#pragma once
+
+// Requires C++20 coroutines; the rest of the library stays C++11.
+
+#include "Animation.h"
+#include <coroutine>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace animation {
+
+
+// Size-classed free lists for coroutine frames. Frames are never returned
+// to the system, so steady-state scripting does not hit the global
+// allocator. The pool is deliberately leaked at exit: scripts held by
+// static objects may be destroyed after any function-local static would
+// be. Not thread-safe, like the rest of the library.
+class FramePool
+{
+public:
+    static FramePool &instance()
+    {
+        static FramePool *pool = new FramePool;
+        return *pool;
+    }
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+public:
+    void *allocate(size_t size)
+    {
+        const size_t index = _index(size);
+        if (index >= kClasses) return ::operator new(size);
+        if (!_free[index]) _grow(index);
+        Block *block = _free[index];
+        _free[index] = block->next;
+        return block;
+    }
+
+    void deallocate(void *pointer, size_t size)
+    {
+        const size_t index = _index(size);
+        if (index >= kClasses) {
+            ::operator delete(pointer);
+            return;
+        }
+        Block *block = static_cast<Block*>(pointer);
+        block->next = _free[index];
+        _free[index] = block;
+    }
+
+private:
+    FramePool(): _free() {}
+
+    struct Block
+    {
+        Block *next;
+    };
+
+    static size_t _index(size_t size)
+    {
+        return size ? (size - 1) / kGranularity : 0;
+    }
+
+    void _grow(size_t index)
+    {
+        const size_t size = (index + 1) * kGranularity;
+        char *chunk = static_cast<char*>(::operator new(size * kBlocksPerChunk));
+        _chunks.push_back(chunk);
+        for (size_t i = 0; i < kBlocksPerChunk; i++)
+        {
+            Block *block = reinterpret_cast<Block*>(chunk + i * size);
+            block->next = _free[index];
+            _free[index] = block;
+        }
+    }
+
+private:
+    static const size_t kGranularity = 64;
+    static const size_t kClasses = 16;
+    static const size_t kBlocksPerChunk = 64;
+
+    Block *_free[kClasses];
+    std::vector<void*> _chunks;
+
+};
+
+
+class ScriptAwaiter;
+
+// Timeline cursor of a running script: each awaited step starts at the
+// exact time the previous one ended, not at the frame that noticed it.
+struct ScriptState
+{
+    TTime time = TTimeMax;
+    ScriptAwaiter *current = nullptr;
+};
+
+
+class ScriptAwaiter
+{
+public:
+    ScriptAwaiter() {}
+    ScriptAwaiter(const ScriptAwaiter &) = delete;
+    ScriptAwaiter &operator=(const ScriptAwaiter &) = delete;
+    virtual ~ScriptAwaiter() {}
+
+public:
+    virtual void begin(TTime start_time) = 0;
+    virtual bool step(TTime now) = 0;
+    virtual TTime end() const = 0;
+
+public: // awaitable
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        ScriptState &state = handle.promise();
+        state.current = this;
+        begin(state.time);
+    }
+
+    void await_resume() const noexcept {}
+
+};
+
+
+class Script
+{
+public:
+    struct promise_type: ScriptState
+    {
+        Script get_return_object()
+        {
+            return Script(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+
+        static void *operator new(size_t size)
+        {
+            return FramePool::instance().allocate(size);
+        }
+
+        static void operator delete(void *pointer, size_t size)
+        {
+            FramePool::instance().deallocate(pointer, size);
+        }
+    };
+
+public:
+    Script(): _handle(nullptr) {}
+
+    Script(Script &&other) noexcept
+        : _handle(std::exchange(other._handle, nullptr))
+    {}
+
+    Script &operator=(Script &&other) noexcept
+    {
+        if (this != &other) {
+            if (_handle) _handle.destroy();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Script()
+    {
+        if (_handle) _handle.destroy();
+    }
+
+public: // easy-to-use
+    void start() { start(Utils::now()); }
+    bool animate() { return animate(Utils::now()); }
+
+public:
+    void start(TTime start_time)
+    {
+        assert(_handle);
+        assert(start_time < TTimeMax);
+        _handle.promise().time = start_time;
+    }
+
+    bool animate(TTime now)
+    {
+        assert(_handle);
+        ScriptState &state = _handle.promise();
+        assert(state.time < TTimeMax);
+        while (!_handle.done())
+        {
+            if (state.current) {
+                if (state.current->step(now)) return true;
+                state.time = state.current->end();
+                state.current = nullptr;
+            }
+            if (now < state.time) return true;
+            _handle.resume();
+        }
+        return false;
+    }
+
+    bool done() const { return !_handle || _handle.done(); }
+
+    // Timeline position; once done(), the exact time the script finished.
+    TTime end() const
+    {
+        assert(_handle);
+        return _handle.promise().time;
+    }
+
+public:
+    auto operator co_await() &&;
+
+private:
+    explicit Script(std::coroutine_handle<promise_type> handle): _handle(handle) {}
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+
+};
+
+
+template<typename T>
+class TweenAwaiter: public ScriptAwaiter
+{
+public:
+    TweenAwaiter(T &target, T complete_state, TTime duration, Interpolator *interpolator)
+        : _target(target)
+        , _start_state(target)
+        , _complete_state(complete_state)
+        , _duration(duration)
+        , _interpolator(interpolator)
+        , _start_time(TTimeMax)
+    {
+        assert(_duration > 0);
+    }
+
+    virtual ~TweenAwaiter() override
+    {
+        delete _interpolator;
+    }
+
+public: // from ScriptAwaiter
+    virtual void begin(TTime start_time) override
+    {
+        _start_time = start_time;
+        _start_state = _target;
+    }
+
+    virtual bool step(TTime now) override
+    {
+        if (now >= end()) {
+            _target = _complete_state;
+            return false;
+        }
+        double ratio = static_cast<double>(now - _start_time) / _duration;
+        if (_interpolator) ratio = _interpolator->value(ratio);
+        _target = (1.0 - ratio) * _start_state + ratio * _complete_state;
+        return true;
+    }
+
+    virtual TTime end() const override
+    {
+        return _start_time + _duration;
+    }
+
+private:
+    T &_target;
+    T _start_state;
+    const T _complete_state;
+    const TTime _duration;
+    Interpolator *_interpolator;
+    TTime _start_time;
+
+};
+
+
+class DelayAwaiter: public ScriptAwaiter
+{
+public:
+    DelayAwaiter(TTime duration)
+        : _duration(duration)
+        , _start_time(TTimeMax)
+    {
+        assert(_duration >= 0);
+    }
+
+public: // from ScriptAwaiter
+    virtual void begin(TTime start_time) override
+    {
+        _start_time = start_time;
+    }
+
+    virtual bool step(TTime now) override
+    {
+        return now < end();
+    }
+
+    virtual TTime end() const override
+    {
+        return _start_time + _duration;
+    }
+
+private:
+    const TTime _duration;
+    TTime _start_time;
+
+};
+
+
+// Runs a prebuilt animation tree as one step of a script.
+class PlayAwaiter: public ScriptAwaiter
+{
+public:
+    PlayAwaiter(Animation *animation)
+        : _animation(animation)
+        , _start_time(TTimeMax)
+    {
+        assert(_animation);
+    }
+
+    virtual ~PlayAwaiter() override
+    {
+        delete _animation;
+    }
+
+public: // from ScriptAwaiter
+    virtual void begin(TTime start_time) override
+    {
+        _start_time = start_time;
+        _animation->start(start_time);
+    }
+
+    virtual bool step(TTime now) override
+    {
+        return _animation->animate(now);
+    }
+
+    virtual TTime end() const override
+    {
+        return _start_time + _animation->duration();
+    }
+
+private:
+    Animation *_animation;
+    TTime _start_time;
+
+};
+
+
+template<size_t N>
+class AllAwaiter: public ScriptAwaiter
+{
+    static_assert(N > 0, "all() needs at least one script");
+
+public:
+    AllAwaiter(std::array<Script, N> &&scripts)
+        : _scripts(std::move(scripts))
+    {}
+
+public: // from ScriptAwaiter
+    virtual void begin(TTime start_time) override
+    {
+        for (Script &script: _scripts)
+        {
+            script.start(start_time);
+        }
+    }
+
+    virtual bool step(TTime now) override
+    {
+        bool running = false;
+        for (Script &script: _scripts)
+        {
+            if (!script.done() && script.animate(now)) running = true;
+        }
+        return running;
+    }
+
+    virtual TTime end() const override
+    {
+        TTime ret = std::numeric_limits<TTime>::min();
+        for (const Script &script: _scripts)
+        {
+            ret = std::max(ret, script.end());
+        }
+        return ret;
+    }
+
+private:
+    std::array<Script, N> _scripts;
+
+};
+
+
+inline auto Script::operator co_await() &&
+{
+    return AllAwaiter<1>(std::array<Script, 1>{{std::move(*this)}});
+}
+
+
+template<typename T>
+TweenAwaiter<T> tween(T &target, T complete_state, TTime duration, Interpolator *interpolator=nullptr)
+{
+    return TweenAwaiter<T>(target, complete_state, duration, interpolator);
+}
+
+inline DelayAwaiter delay(TTime duration)
+{
+    return DelayAwaiter(duration);
+}
+
+inline PlayAwaiter play(Animation *animation)
+{
+    return PlayAwaiter(animation);
+}
+
+template<typename... Scripts>
+AllAwaiter<sizeof...(Scripts)> all(Scripts &&... scripts)
+{
+    return AllAwaiter<sizeof...(Scripts)>(std::array<Script, sizeof...(Scripts)>{{std::move(scripts)...}});
+}
+
+
+// Drives many concurrent scripts from the same TTime clock as Animation.
+class ScriptRunner
+{
+public: // easy-to-use
+    void add(Script &&script) { add(std::move(script), Utils::now()); }
+    bool animate() { return animate(Utils::now()); }
+
+public:
+    void add(Script &&script, TTime start_time)
+    {
+        script.start(start_time);
+        _scripts.push_back(std::move(script));
+    }
+
+    bool animate(TTime now)
+    {
+        for (size_t index = 0; index < _scripts.size();)
+        {
+            if (_scripts[index].animate(now)) {
+                index++;
+                continue;
+            }
+            _scripts[index] = std::move(_scripts.back());
+            _scripts.pop_back();
+        }
+        return !_scripts.empty();
+    }
+
+    size_t size() const { return _scripts.size(); }
+
+private:
+    std::vector<Script> _scripts;
+
+};
+
+
+}
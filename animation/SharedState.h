@@ -0,0 +1,249 @@
+#pragma once
+
+#include "Utils.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <cstddef>
+
+namespace animation {
+
+
+// The seqlock is only valid between processes if these atomics never fall
+// back to a process-local lock. The macros are per type, so pick the ones
+// the fixed-width types are defined as.
+static_assert((std::is_same<uint64_t, unsigned long>::value ? ATOMIC_LONG_LOCK_FREE : ATOMIC_LLONG_LOCK_FREE) == 2,
+        "std::atomic<uint64_t> must always be lock-free");
+static_assert((std::is_same<uint32_t, unsigned int>::value ? ATOMIC_INT_LOCK_FREE : ATOMIC_LONG_LOCK_FREE) == 2,
+        "std::atomic<uint32_t> must always be lock-free");
+
+
+// Layout of a shared state segment: a header followed by two frame
+// buffers. The writer fills the buffer it did not publish last, guarded by
+// that buffer's sequence counter (odd while writing), then publishes it.
+// Readers work in place on the mapping and retry if the sequence moved.
+struct SharedStateHeader
+{
+    static const uint32_t kMagic = 0x414e494d; // "ANIM"
+    static const uint32_t kVersion = 1;
+
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t element_size;
+    uint32_t capacity;
+    std::atomic<uint64_t> generation;
+    std::atomic<uint64_t> sequence[2];
+    std::atomic<uint32_t> count[2];
+
+    template<typename T>
+    static size_t bufferOffset()
+    {
+        const size_t align = alignof(T) > alignof(SharedStateHeader) ? alignof(T) : alignof(SharedStateHeader);
+        return (sizeof(SharedStateHeader) + align - 1) / align * align;
+    }
+};
+
+
+template<typename T>
+class SharedStateWriter
+{
+    static_assert(std::is_trivially_copyable<T>::value, "shared state must be trivially copyable");
+
+public:
+    SharedStateWriter(const std::string &name, size_t capacity)
+        : _name(name)
+        , _capacity(capacity)
+        , _size(_segmentSize(capacity))
+        , _fd(-1)
+        , _header(nullptr)
+    {
+        assert(capacity > 0);
+        _fd = shm_open(_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (_fd < 0) throw std::runtime_error("shm_open failed for " + _name);
+        if (ftruncate(_fd, _size) < 0) {
+            _release();
+            throw std::runtime_error("ftruncate failed for " + _name);
+        }
+        void *address = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (address == MAP_FAILED) {
+            _release();
+            throw std::runtime_error("mmap failed for " + _name);
+        }
+        // magic goes last so that readers reject a half-initialized header
+        _header = new (address) SharedStateHeader;
+        _header->version = SharedStateHeader::kVersion;
+        _header->element_size = sizeof(T);
+        _header->capacity = capacity;
+        _header->generation.store(0, std::memory_order_relaxed);
+        for (size_t buffer = 0; buffer < 2; buffer++)
+        {
+            _header->sequence[buffer].store(0, std::memory_order_relaxed);
+            _header->count[buffer].store(0, std::memory_order_relaxed);
+        }
+        _header->magic.store(SharedStateHeader::kMagic, std::memory_order_release);
+    }
+
+    SharedStateWriter(const SharedStateWriter &) = delete;
+    SharedStateWriter &operator=(const SharedStateWriter &) = delete;
+
+    ~SharedStateWriter()
+    {
+        _release();
+    }
+
+public:
+    // Returns the index readers see this property at.
+    size_t bind(const T &property)
+    {
+        assert(_properties.size() < _capacity);
+        _properties.push_back(&property);
+        return _properties.size() - 1;
+    }
+
+    void publish()
+    {
+        const uint64_t generation = _header->generation.load(std::memory_order_relaxed) + 1;
+        const size_t buffer = generation & 1;
+        std::atomic<uint64_t> &sequence = _header->sequence[buffer];
+        const uint64_t begin = sequence.load(std::memory_order_relaxed) + 1;
+        sequence.store(begin, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        T *values = _buffer(buffer);
+        const size_t count = _properties.size();
+        for (size_t index = 0; index < count; index++)
+        {
+            values[index] = *_properties[index];
+        }
+        _header->count[buffer].store(count, std::memory_order_relaxed);
+        sequence.store(begin + 1, std::memory_order_release);
+        _header->generation.store(generation, std::memory_order_release);
+    }
+
+public:
+    const std::string &name() const { return _name; }
+    size_t size() const { return _properties.size(); }
+    uint64_t generation() const { return _header->generation.load(std::memory_order_relaxed); }
+
+private:
+    static size_t _segmentSize(size_t capacity)
+    {
+        return SharedStateHeader::bufferOffset<T>() + 2 * capacity * sizeof(T);
+    }
+
+    T *_buffer(size_t buffer)
+    {
+        char *base = reinterpret_cast<char*>(_header) + SharedStateHeader::bufferOffset<T>();
+        return reinterpret_cast<T*>(base) + buffer * _capacity;
+    }
+
+    void _release()
+    {
+        if (_header) munmap(_header, _size);
+        _header = nullptr;
+        if (_fd >= 0) {
+            close(_fd);
+            shm_unlink(_name.c_str());
+        }
+        _fd = -1;
+    }
+
+private:
+    const std::string _name;
+    const size_t _capacity;
+    const size_t _size;
+    int _fd;
+    SharedStateHeader *_header;
+    std::vector<const T*> _properties;
+
+};
+
+
+template<typename T>
+class SharedStateReader
+{
+    static_assert(std::is_trivially_copyable<T>::value, "shared state must be trivially copyable");
+
+public:
+    SharedStateReader(const std::string &name)
+        : _name(name)
+        , _size(0)
+        , _header(nullptr)
+    {
+        int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+        if (fd < 0) throw std::runtime_error("shm_open failed for " + _name);
+        struct stat info;
+        if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(SharedStateHeader)) {
+            close(fd);
+            throw std::runtime_error("bad shared state segment " + _name);
+        }
+        _size = info.st_size;
+        void *address = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) throw std::runtime_error("mmap failed for " + _name);
+        _header = static_cast<const SharedStateHeader*>(address);
+        if (_header->magic.load(std::memory_order_acquire) != SharedStateHeader::kMagic
+                || _header->version != SharedStateHeader::kVersion
+                || _header->element_size != sizeof(T)
+                || _size < SharedStateHeader::bufferOffset<T>() + 2 * _header->capacity * sizeof(T)) {
+            munmap(address, _size);
+            throw std::runtime_error("incompatible shared state segment " + _name);
+        }
+    }
+
+    SharedStateReader(const SharedStateReader &) = delete;
+    SharedStateReader &operator=(const SharedStateReader &) = delete;
+
+    ~SharedStateReader()
+    {
+        munmap(const_cast<SharedStateHeader*>(_header), _size);
+    }
+
+public:
+    uint64_t generation() const
+    {
+        return _header->generation.load(std::memory_order_acquire);
+    }
+
+    // Calls visitor(const T *values, size_t count) on the latest published
+    // frame directly in shared memory, again if the writer overtook it, and
+    // returns the generation that was read. The visitor must only read.
+    template<typename Visitor>
+    uint64_t read(Visitor visitor) const
+    {
+        while (true)
+        {
+            const uint64_t generation = _header->generation.load(std::memory_order_acquire);
+            const size_t buffer = generation & 1;
+            const std::atomic<uint64_t> &sequence = _header->sequence[buffer];
+            const uint64_t begin = sequence.load(std::memory_order_acquire);
+            if (begin & 1) continue;
+            const size_t count = _header->count[buffer].load(std::memory_order_relaxed);
+            visitor(_buffer(buffer), count);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == begin) return generation;
+        }
+    }
+
+private:
+    const T *_buffer(size_t buffer) const
+    {
+        const char *base = reinterpret_cast<const char*>(_header) + SharedStateHeader::bufferOffset<T>();
+        return reinterpret_cast<const T*>(base) + buffer * _header->capacity;
+    }
+
+private:
+    const std::string _name;
+    size_t _size;
+    const SharedStateHeader *_header;
+
+};
+
+
+}
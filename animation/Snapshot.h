@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Utils.h"
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+
+namespace animation {
+
+
+// Flat blob of timing state written by Animation::snapshot(). clear()
+// keeps the capacity, so a ring of snapshots stops allocating after the
+// first lap.
+class Snapshot
+{
+public:
+    Snapshot(): _size(0) {}
+
+public:
+    void clear() { _size = 0; }
+    size_t size() const { return _size; }
+    const uint8_t *data() const { return _data.data(); }
+
+    template<typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot state must be trivially copyable");
+        const size_t required = _size + sizeof(T);
+        if (required > _data.size()) {
+            size_t capacity = _data.size() * 2;
+            if (capacity < kMinCapacity) capacity = kMinCapacity;
+            if (capacity < required) capacity = required;
+            _data.resize(capacity);
+        }
+        memcpy(&_data[_size], &value, sizeof(T));
+        _size += sizeof(T);
+    }
+
+private:
+    static const size_t kMinCapacity = 256;
+
+    std::vector<uint8_t> _data;
+    size_t _size;
+
+};
+
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(const Snapshot &snapshot)
+        : _snapshot(snapshot)
+        , _offset(0)
+    {}
+
+public:
+    template<typename T>
+    void read(T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot state must be trivially copyable");
+        assert(_offset + sizeof(T) <= _snapshot.size());
+        memcpy(&value, _snapshot.data() + _offset, sizeof(T));
+        _offset += sizeof(T);
+    }
+
+    bool done() const { return _offset == _snapshot.size(); }
+
+private:
+    const Snapshot &_snapshot;
+    size_t _offset;
+
+};
+
+
+}
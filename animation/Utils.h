@@ -21,6 +21,13 @@ public:
         return tv.tv_sec * 1e3 + tv.tv_usec * 1e-3;
     }
 
+    static TTime microseconds()
+    {
+        timeval tv;
+        gettimeofday(&tv, nullptr);
+        return static_cast<TTime>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
 };
 
 
@@ -18,6 +18,8 @@ static GLuint g_program = 0;
 static GLuint g_MVPLocation = 0;
 static GLuint g_vao = 0;
 static GLuint g_vbo = 0;
+static animation::Animation *g_animation = nullptr;
+static const animation::TTime IDLE_TIME = 2000;
 
 std::vector<glm::vec2> centers;
 
@@ -187,21 +189,37 @@ animation::Animation* setupAnimation()
     return dynamic_cast<animation::Animation*>(group);
 }
 
-void render()
+void animate(animation::TTime now)
 {
-    //glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    static animation::Animation *animation = nullptr;
-    if (!animation) 
+    if (!g_animation)
     {
-        animation = setupAnimation();
-        animation->start();
+        g_animation = setupAnimation();
+        g_animation->start(now + IDLE_TIME);
     }
-    if (!animation->animate()) {
-        delete animation;
-        animation = nullptr;
+    if (!g_animation->animate(now)) {
+        delete g_animation;
+        g_animation = nullptr;
     }
+}
+
+// Blocks until the animation next changes or an event arrives, so the
+// loop sleeps between runs instead of rendering identical frames.
+void waitForUpdate(animation::TTime now)
+{
+    animation::TTime next = g_animation ? g_animation->nextUpdateTime(now) : now;
+    if (next <= now) {
+        glfwPollEvents();
+    } else if (next == animation::TTimeMax) {
+        glfwWaitEvents();
+    } else {
+        glfwWaitEventsTimeout((next - now) / 1000.0);
+    }
+}
+
+void render()
+{
+    //glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT);
 
     //static int count = 0;
     //std::cout << "loop #" << ++count << std::endl;
@@ -243,10 +261,13 @@ int main(int argc, char *argv[])
     initialize();
     setup();
     while (!glfwWindowShouldClose(g_window)) {
+        animation::TTime now = animation::Utils::now();
+        animate(now);
         render();
         glfwSwapBuffers(g_window);
-        glfwPollEvents();
+        waitForUpdate(now);
     }
+    delete g_animation;
     finalize();
     return 0;
 }
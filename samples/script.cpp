@@ -0,0 +1,110 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "animation/Animation.h"
+#include "animation/AnimationGroup.h"
+#include "animation/Script.h"
+#include "animation/Scheduler.h"
+#include "animation/CompressedTrack.h"
+#include "animation/Blender.h"
+#include "animation/Lazy.h"
+
+// Headless choreography on a simulated 60Hz clock: a script sequences a
+// card, a compressed track and a blend between two layers, while a
+// scheduler runs background particles and lazy properties, culled half of
+// the time, feed a label.
+// Exits with failure if any of them doesn't land on its complete state.
+
+static const animation::TTime FRAME = 16;
+static const size_t PARTICLES = 1000;
+
+struct Card
+{
+    float x;
+    float y;
+    float alpha;
+};
+
+animation::Script showCard(Card &card, const animation::CompressedTrack<float> &bounce)
+{
+    co_await animation::tween(card.x, 100.0f, 300);
+    co_await animation::delay(100);
+    co_await animation::all(
+        [](Card &card) -> animation::Script {
+            co_await animation::tween(card.alpha, 1.0f, 200, new animation::SineInterpolator);
+        }(card),
+        [](Card &card, const animation::CompressedTrack<float> &bounce) -> animation::Script {
+            co_await animation::play(new animation::TrackAnimation<float>(card.y, &bounce));
+        }(card, bounce));
+}
+
+animation::Script crossfade(animation::Blender<float> &blender, size_t layer)
+{
+    co_await animation::delay(200);
+    co_await animation::play(blender.fade(layer, 1.0, 400));
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<float> samples;
+    for (int i = 0; i <= 60; i++)
+    {
+        samples.push_back(50.0f * (1.0f - (i - 30) * (i - 30) / 900.0f));
+    }
+    animation::CompressedTrack<float> bounce(samples, 10, 0.5);
+    std::cout << "bounce: " << bounce.keys() << " keys, ratio " << bounce.compressionRatio()
+        << ", max error " << bounce.maxError() << std::endl;
+
+    Card card = { 0, 0, 0 };
+    float color = 0;
+    animation::Blender<float> blender;
+    size_t base = blender.addLayer(1.0);
+    size_t highlight = blender.addLayer(0.0);
+    blender.bind(base, color) = 0.25f;
+    blender.bind(highlight, color) = 1.0f;
+
+    animation::TTime now = 0;
+    animation::ScriptRunner scripts;
+    scripts.add(showCard(card, bounce), now);
+    scripts.add(crossfade(blender, highlight), now);
+
+    std::vector<float> particles(PARTICLES, 0);
+    animation::Scheduler scheduler(500);
+    for (size_t index = 0; index < PARTICLES; index++)
+    {
+        animation::Animation *particle = new animation::PropertyAnimation<float>(particles[index], 0, 1, 200 + index % 400, new animation::LinearInterpolator);
+        particle->start(now);
+        scheduler.add(particle, index % 2 ? animation::Scheduler::Low : animation::Scheduler::Normal,
+                index % 3 ? animation::Scheduler::EveryFrame : animation::Scheduler::HalfRate);
+    }
+
+    animation::LazyProperty<float> *label_alpha = new animation::LazyProperty<float>(0, 1, 200);
+    animation::LazyProperty<float> *label_x = new animation::LazyProperty<float>(0, 1, 300);
+    animation::SequentialAnimationGroup label;
+    label.add(label_alpha);
+    label.add(label_x);
+    label.start(now);
+
+    bool running = true;
+    while (running)
+    {
+        now += FRAME;
+        running = scripts.animate(now);
+        blender.resolve();
+        running = scheduler.animate(now) || running;
+        label.setCulled(now % 100 >= 50);
+        running = label.animate(now) || running;
+    }
+
+    std::cout << "done at " << now << "ms: card " << card.x << ' ' << card.y << ' ' << card.alpha
+        << ", color " << color << ", label " << label_alpha->get() << ' ' << label_x->get()
+        << ", deferred " << scheduler.stats().total_deferred << std::endl;
+
+    bool complete = card.x == 100 && card.alpha == 1 && card.y == bounce.value(bounce.duration())
+        && color == 1 && label_alpha->get() == 1 && label_x->get() == 1;
+    for (float particle: particles)
+    {
+        if (particle != 1) complete = false;
+    }
+    return complete ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "animation/Animation.h"
+#include "animation/AnimationGroup.h"
+#include "animation/SharedState.h"
+
+// Publishes animated values from one process and reads them from another,
+// reporting throughput and any torn frame. All properties run the same
+// animation, so a consistent frame holds identical values.
+
+static const char *SEGMENT = "/animation_shared_state";
+static const size_t COUNT = 4096;
+static const animation::TTime DURATION = 2000;
+static const animation::TTime TIMEOUT = 5000;
+
+// Waits for the writer to create the segment and publish its first frame.
+animation::SharedStateReader<float> *connect()
+{
+    const animation::TTime deadline = animation::Utils::now() + TIMEOUT;
+    while (animation::Utils::now() < deadline)
+    {
+        try {
+            animation::SharedStateReader<float> *state = new animation::SharedStateReader<float>(SEGMENT);
+            while (state->generation() == 0 && animation::Utils::now() < deadline)
+            {
+                usleep(1000);
+            }
+            if (state->generation() > 0) return state;
+            delete state;
+        } catch (const std::runtime_error &) {
+            // not created or not initialized yet
+        }
+        usleep(1000);
+    }
+    return nullptr;
+}
+
+int fail(pid_t writer, const char *message)
+{
+    std::cerr << "reader: " << message << std::endl;
+    kill(writer, SIGTERM);
+    waitpid(writer, nullptr, 0);
+    return EXIT_FAILURE;
+}
+
+int reader(pid_t writer)
+{
+    animation::SharedStateReader<float> *connected = connect();
+    if (!connected) return fail(writer, "timed out waiting for the writer");
+    std::unique_ptr<animation::SharedStateReader<float>> state(connected);
+    uint64_t frames = 0;
+    uint64_t torn = 0;
+    uint64_t last = 0;
+    bool complete = false;
+    animation::TTime begin = animation::Utils::now();
+    animation::TTime updated = begin;
+    while (!complete)
+    {
+        if (state->generation() == last) {
+            if (animation::Utils::now() - updated > TIMEOUT) return fail(writer, "writer stopped publishing");
+            sched_yield();
+            continue;
+        }
+        updated = animation::Utils::now();
+        bool consistent = true;
+        last = state->read([&consistent, &complete](const float *values, size_t count) {
+            for (size_t i = 1; i < count; i++)
+            {
+                if (values[i] != values[0]) consistent = false;
+            }
+            complete = values[0] == 1;
+        });
+        frames++;
+        if (!consistent) torn++;
+    }
+    animation::TTime elapsed = animation::Utils::now() - begin;
+    std::cout << "reader: " << frames << " frames in " << elapsed << "ms, "
+        << frames * 1000 / (elapsed ? elapsed : 1) << " frames/s, "
+        << torn << " torn" << std::endl;
+    int status = 0;
+    waitpid(writer, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) return EXIT_FAILURE;
+    return torn ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int writer()
+{
+    try {
+        std::vector<float> values(COUNT, 0);
+        animation::SharedStateWriter<float> state(SEGMENT, COUNT);
+        animation::ParallelAnimationGroup group;
+        for (float &value: values)
+        {
+            group.add(new animation::PropertyAnimation<float>(value, 0, 1, DURATION));
+            state.bind(value);
+        }
+        uint64_t frames = 0;
+        animation::TTime begin = animation::Utils::now();
+        group.start(begin);
+        bool running = true;
+        while (running)
+        {
+            running = group.animate();
+            state.publish();
+            frames++;
+        }
+        animation::TTime elapsed = animation::Utils::now() - begin;
+        std::cout << "writer: " << frames << " frames in " << elapsed << "ms, "
+            << frames * 1000 / (elapsed ? elapsed : 1) << " frames/s, "
+            << frames * COUNT * sizeof(float) / 1000 / (elapsed ? elapsed : 1) << "MB/s" << std::endl;
+        return EXIT_SUCCESS;
+    } catch (const std::exception &e) {
+        std::cerr << "writer: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // a segment left behind by a crashed run must not be mistaken for ours
+    shm_unlink(SEGMENT);
+    pid_t child = fork();
+    if (child < 0) {
+        std::cerr << "fork failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (child == 0) {
+        return writer();
+    }
+    return reader(child);
+}